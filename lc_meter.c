@@ -57,6 +57,31 @@ The high range Capacitor measurement utilizes P1.4 and P1.3. P1.4 is configured
 The ESR measurement is based on the high range capacitance measurement (P1.4, P1.3) with an additional P1.2 pin. Here we use P1.4 as ADC input. A 100ohm resistor is used between P1.2 and P1.4, with a target capacitor in place between P1.4 and ground, this three nodes (P1.2, P1.4, Gnd) forms a voltage divider. By measuring the voltage at P1.4 we can derived the resistance (or ESR) of the target capacitor.
  
  
+Once a LC reading is steady (part attached, not fluctuating) readings are pipelined. The charge phase and the counting gate are both timed by TimerA and closed in the ISRs, so the next gate starts as soon as a count is latched and the float conversion / LCD output of that count happens during the next gate's 6.25ms charge phase. Each reading still gets the same 6.25ms charge and 32.8ms gate. The overlap itself only hides the probe and the conversion / display time, ~1.5ms per reading: serial readings back to back would take probe + 6.25ms + 32.8ms + conversion / display + 3.1ms loop delay = ~43.7ms, pipelined ones take 39.0ms (~11% faster).
+ 
+ 
+Pipelining also changes the cadence, and that's the bigger difference you'll see. A steady reading no longer waits out 256 loop passes (~0.84s) before the next one, so LCD row 1 is rewritten every ~39ms, and the PULSE_PIN disconnect done before each free-run reading is skipped while readings stay steady. Any open / fluctuating read drops back to the full probe sequence and the 0.84s cadence.
+ 
+ 
+Counts come out the same as serial ones as long as the conversion / display plus the 3.1ms loop delay is done within the 6.25ms charge phase, ie. the main loop is back in gate_wait() before the gate opens. tools/lcsim runs this firmware against a simulated tank and logs every gate ("make -C tools check"): the main loop is back after 3.4ms, 4.9ms w/ 1.5ms billed for the float conversion, and pipelined counts stay within one edge of the serial count.
+ 
+ 
+For production fixtures there is a scan mode (#define SCAN_CH). An external analog mux (ie. 4051) picks the part under test, its select lines come from a 74HC595 that shares the LCD CLK/DATA lines, w/ P2.4 as the latch strobe. Each channel keeps its own cached state (part type, high cap charge range, last value, settle status), so once a channel's part is known we skip the presence probing, the range trials and the mode detection on it, and LC channels are pipelined across the scan. A locked high cap channel is checked against its last value, a jump of more than 1/8 is flagged and re-probed, and if it won't discharge flat the part is probed the long way. An out of range part is discharged on its own channel before the mux moves on, the next gate isn't started early past it. Calibrate w/ the fixture empty and let it scan once more before putting parts in, each channel learns its L or C wiring from that open reading (a part in the socket before that leaves the channel undetected). tools/lcsim_scan runs this on a simulated 8 channel fixture ("make -C tools check"), w/ 4 inductors and 4 x 220uF it does ~345 parts/min, locked LC channels take one gate and no adc probing, locked high caps a single charge trial.
+ 
+ 
+Host command interface. A timer1 software UART (9600 8N1, TXD P2.0, RXD P2.1, the USCI pins are taken) accepts single character commands. The first one puts the meter in host mode, free-run stops and it sleeps until the next command, so a command is acted upon right away.
+
+  m      single shot, measure now, replies "m,t_rx,t_done,latency,ch,mode,status,n,value,esr"
+  1..9   readings averaged per single shot
+  a      auto detect (default)
+  l c    force inductance / capacitance (LC), skip auto detection, O if it reads open
+  h H    force capacitance hi, start from 47k / 100ohm range, O if nothing is there
+  x      comparator filter on-off
+  f      back to free-run
+
+Every reply starts w/ the command and the time (us) it was received, ie. "l,123456". Times come from timer1 (0.5us) and wrap every 2^31us (~35.8min), latency is t_done - t_rx and comes out right across the wrap, a host that wants t_rx / t_done over a longer session has to unwrap them, the reply itself takes ~1ms per character on top. Mode 0 is 0.1nH, 1 is 0.1pF, 2 is 0.1nF units, esr in 0.01ohm. Status is the worst of the readings taken, K ok, W not settled (first read after open, or part type changed mid shot), O open, R out of range. Only the n settled (K) readings of one part type are averaged into value and esr, n=0 leaves them 0. "m,t_rx,E" means not calibrated yet. The first command stops free-run, which is what walks thru calibration, so each "E" reply is followed by one calibration gate instead: send "m" w/ the leads open, then again w/ calibrate held (the lcd says "Calibrated"), or send "f" and calibrate as usual. Any other unknown command gets "?". Other commands sent while a single shot is running are answered right away and the shot carries on, its reply keeps the t_rx of its "m". Another "m" starts the shot over. tools/lc_host.py plays the test station, it runs lcsim in pty mode, sends commands over the simulated uart and checks the replies and their time stamps against when the bytes were on the wire ("make -C tools check").
+ 
+ 
 The above is a high level overview on the set-up. You can find out more by googling the subject. I studied various designs from the internet and come up w/ this. And at this stage I want to have the most bare-bone set-up to play with.
  
 Some Build Notes
@@ -95,6 +120,7 @@ nice if you give credit, mention my site if you adopt much of my code
 #define EBLCD_CLK	BIT5	// P1
 #define EBLCD_DATA	BIT7	// P1
 #define EBLCD_RS	BIT3	// P2
+#define MUX_LATCH	BIT4	// P2, latch strobe of fixture mux select register (shares lcd CLK/DATA)
 
 //______________________________________________________________________
 void eblcd_write(uint8_t d, uint8_t cmd) {
@@ -196,8 +222,15 @@ void eblcd_dec32(uint32_t d, uint8_t dec) {
 	}//if
 }
 
-
-
+//______________________________________________________________________
+// fixture scan, external analog mux select lines come from a 74hc595 hanging on
+// the same CLK/DATA lines as the lcd. we shift the channel as a "set ddram address"
+// command (harmless, all displays re-position anyway) then latch it to the mux
+void mux_select(uint8_t ch) {
+	eblcd_write(0x80|ch, 1);
+	P2OUT |= MUX_LATCH;
+	P2OUT &= ~MUX_LATCH;
+}
 
 
 //________________________________________________________________________________
@@ -259,20 +292,25 @@ void eblcd_setup() {
 volatile uint16_t ticks=0,clicks=0;
 volatile uint16_t capture_cnt=0;
 volatile uint16_t ov_cnt=0;
+volatile uint8_t gate_busy=0;
 
 
 //#define DEBUG	1
+//#define SCAN_CH	8		// multi-part fixture, scan this many channels via external mux
 #define MEASURE_PIN	BIT4
 #define PULL_PIN	BIT3
 #define PULSE_PIN	BIT2
 //________________________________________________________________________________
-uint16_t capture_pulses() {
+// start a pulse counting gate and return right away
+// both the Cb charge phase and the gate are timed by timerA, the ISRs latch 'capture_cnt'
+// and clear 'gate_busy' when done. cpu is free to work on the previous reading meanwhile
+void gate_start() {
 
 	capture_cnt = 0;
 
 	ADC10CTL0 = ADC10CTL1 = ADC10AE0 = 0;
 	P1OUT &= ~(PULL_PIN|MEASURE_PIN);
-	P1DIR &= ~(PULL_PIN|MEASURE_PIN);
+	P1DIR &= ~(PULL_PIN|MEASURE_PIN|PULSE_PIN);	// measure_high_cap() leaves the pulse pin driven low
 
 	CACTL2 = (P2CA4) | (P2CA3|P2CA2);		// CA1=(+), CA6=(-)
 	// CACTL2 |= CAF;						// DO NOT use filter, we won't oscillate w/ them
@@ -284,26 +322,112 @@ uint16_t capture_pulses() {
 	P1REN &= ~BIT3;
 	CACTL1 = CAON;
 
+	gate_busy = 1;
+	TA0CCR0 = 12500;			// 100000 cycles (smclk/8) to allow charge of Cb, ie need longer for larger caps
+	TA0CCTL0 = CCIE;			// CCR0 ISR opens the gate when charge phase is over
+	TA0CTL = TASSEL_2|MC_2|ID_3|TACLR;		// smclk/8, cont.
 	_BIS_SR(GIE);
+}
 
-	__delay_cycles(100000);		// adjust this to allow charge of Cb, ie need delay for larger caps
-	TA0CTL = TASSEL_2|MC_2|ID_3|TACLR|TAIE;		// smclk/8, cont. need overflow interrupt
-	CACTL1 |= CAIE;				// comparator interrupt on, count pulses from our LC tank
-	_BIS_SR(LPM0_bits + GIE); 	// we now wait for timerA to overflow, loops items
+//________________________________________________________________________________
+void gate_wait() {
 	_BIC_SR(GIE);
-	CACTL1 &= ~CAIE;			// done, no more counting on comparator pulses
+	while (gate_busy) {
+		_BIS_SR(LPM0_bits + GIE); 	// we now wait for timerA to overflow, loops items
+		_BIC_SR(GIE);
+	}//while
+	_BIS_SR(GIE);
+}
+
+//________________________________________________________________________________
+uint16_t capture_pulses() {
+
+	gate_start();
+	gate_wait();
 
 	// 'capture_cnt' now has number of pulses within the timerA overflow period
 	// frequency of LC tank would be 16Mhz/64k * 'capture_cnt'
-
-	//_____________ done, clean-up turn things off
-	TA0CTL = 0;						// no timer
 	//CACTL2 = CACTL1 = CAPD = 0;	// DON'T turn off comparator here, continous read will be affected
-	_BIS_SR(GIE);
 
 	return capture_cnt;
 }
 
+//________________________________________________________________________________
+// abandon a running gate, ie. host wants a fresh reading now
+void gate_stop() {
+	_BIC_SR(GIE);
+	CACTL1 &= ~CAIE;
+	TA0CTL = TA0CCTL0 = 0;
+	gate_busy = 0;
+	_BIS_SR(GIE);
+}
+
+//________________________________________________________________________________
+// host command interface, timer1 software uart 9600 8N1
+// usci pins (P1.1, P1.2) are taken by the meter, so we do it on TA1.0 / TA1.1 pins
+// timer1 free runs at smclk/8 (0.5us), its overflow count in 'ticks' makes the time stamp
+#define UART_TXD	BIT0	// P2, TA1.0
+#define UART_RXD	BIT1	// P2, TA1.1 CCI1A
+#define UART_TBIT	(MHZ*1000000/8/9600)
+
+volatile uint8_t rx_bits=8, rx_data=0, rx_c=0;
+volatile uint32_t rx_time=0;
+
+void uart_setup() {
+	P2SEL |= UART_TXD|UART_RXD;
+	P2DIR |= UART_TXD;
+	TA1CCTL0 = OUT;							// TXD idle at mark
+	TA1CCTL1 = SCS|CM_2|CAP|CCIE;			// sync, falling edge capture, catch start bit
+	TA1CTL = TASSEL_2|MC_2|ID_3|TACLR|TAIE;	// smclk/8, cont. need overflow interrupt for time stamp
+}
+
+//________________________________________________________________________________
+// time stamp in 0.5us units, call w/ interrupts off
+uint32_t time_stamp() {
+	uint16_t hi = ticks, lo = TA1R;
+	if ((TA1CTL & TAIFG) && lo < 0x8000) hi++;	// overflow not serviced yet
+	return ((uint32_t) hi << 16) | lo;
+}
+
+//________________________________________________________________________________
+// polled, bit edges are timed by the TA1.0 output unit so comparator ISR load
+// during a running gate only delays us, not the bits on the wire
+void uart_putc(uint8_t d) {
+	uint16_t bits = (d << 1) | 0x200;		// start, 8 data, stop
+	uint8_t i = 10;
+	TA1CCR0 = TA1R + UART_TBIT;
+	while (i--) {
+		TA1CCTL0 = (bits & 1) ? OUTMOD_1 : OUTMOD_5;	// set / reset TXD on next compare
+		while (!(TA1CCTL0 & CCIFG));
+		TA1CCR0 += UART_TBIT;
+		bits >>= 1;
+	}//while
+	TA1CCTL0 = OUT;		// back to idle
+}
+
+void uart_puts(char *p) {
+	while (*p) uart_putc(*p++);
+}
+
+//________________________________________________________________________________
+void uart_dec32(uint32_t d) {
+	uint8_t buf[10], i=0;
+
+	do {
+		buf[i++] = (d%10) + '0';
+		d /= 10;
+	} while (d);
+	while (i) uart_putc(buf[--i]);
+}
+
+//________________________________________________________________________________
+// all replies start w/ the command and the time (us) it was received
+void uart_reply(uint8_t c, uint32_t t) {
+	uart_putc(c);
+	uart_putc(',');
+	uart_dec32(t>>1);
+}
+
 
 //________________________________________________________________________________
 //
@@ -312,8 +436,10 @@ uint16_t capture_pulses() {
 // our target capacitor on the inverting input and time
 // how long it takes to charge up the unknown capacitor to 0.55V
 // we setup the comparator to trip a timerA interrupt when the 0.55V is reached
+// 'range' is the charge pin to start with, 0 to probe for presence and try from low range
+// it returns w/ the charge pin that worked, so a known part can skip probing and trials
 
-float measure_high_cap(uint8_t mode, float *esr) {
+float measure_high_cap(uint8_t mode, uint8_t *range, float *esr) {
 
 	_BIC_SR(GIE);						// stop things, setup time
 	P1OUT &= ~(PULL_PIN|MEASURE_PIN);
@@ -322,13 +448,29 @@ float measure_high_cap(uint8_t mode, float *esr) {
 	P1SEL2 &= ~PULL_PIN;
 
 	// setup adc on measure pin, this time for determining whatever a cap is connected
-	ADC10CTL0 = ADC10SHT_2 + ADC10ON + ADC10IE; 
+	ADC10CTL0 = ADC10SHT_2 + ADC10ON; 	// polled, no ADC10IE as we open GIE while waiting below
 	ADC10CTL1 = INCH_4;
 	ADC10AE0 |= MEASURE_PIN;
 
 	uint16_t last_adc=1023;
 	uint8_t hit=0;
-	while (1) {
+	if (*range) {						// known part, no probing, just make sure it's flat
+		P1OUT &= ~PULSE_PIN;
+		do {
+			P1DIR |= MEASURE_PIN|PULSE_PIN;	// discharge via measure and pulse pins
+			_BIS_SR(GIE);					// let timer1 (uart, time stamp) catch up
+			__delay_cycles(50000);
+			_BIC_SR(GIE);
+			P1DIR &= ~MEASURE_PIN;			// read adc
+			ADC10CTL0 |= ENC + ADC10SC;
+			while (ADC10CTL1 & ADC10BUSY);
+		} while (ADC10MEM>1 && ++hit<20);
+		if (ADC10MEM>1) {				// won't go flat, not the part we knew, probe it the long way
+			*range = 0;
+			hit = 0;					// fresh probe, an empty socket floats and reads not present
+		}//if
+	}//if
+	while (!*range) {
 #ifdef DEBUG
 		eblcd_clear(1); eblcd_dec16(ADC10MEM); eblcd_putc('='); eblcd_dec16(hit);
 #endif
@@ -344,8 +486,10 @@ float measure_high_cap(uint8_t mode, float *esr) {
 		P1DIR |= PULSE_PIN;
 		P1OUT &= ~PULSE_PIN;
 		CACTL2 = CACTL1 = CAPD = 0;		
+		_BIS_SR(GIE);					// let timer1 (uart, time stamp) catch up
 		if (hit>2) eblcd_puts("Discharging", 1);
 		__delay_cycles(1000000);		// need some time
+		_BIC_SR(GIE);
 		hit++;
 	}//while
 	P1DIR &= ~PULSE_PIN;
@@ -355,7 +499,8 @@ float measure_high_cap(uint8_t mode, float *esr) {
 #endif
 
 	float cx = 1000.0;
-	uint8_t charge_pin = PULL_PIN;
+	uint8_t charge_pin = *range ? *range : PULL_PIN;
+	*range = 0;
 
 	while (charge_pin) {
 	// we sould like to get the cap values 1st;
@@ -369,6 +514,7 @@ float measure_high_cap(uint8_t mode, float *esr) {
 
 	// charge, capture time to reach 0.55V
 	ov_cnt = 0;
+	P1DIR &= ~(PULL_PIN|PULSE_PIN|MEASURE_PIN);	// only the charge pin drives the cap, depletion below leaves them low
 	P1OUT |= charge_pin;
 	P1DIR |= charge_pin;
 
@@ -391,8 +537,8 @@ float measure_high_cap(uint8_t mode, float *esr) {
 	}//if
 
 	CAPD = CACTL2 = CACTL1 = 0;				// comparator off
-	TA0CTL = TA0CCTL1 = 0;					// timer off
-	_BIC_SR(GIE);							// no more interrupts
+	TA0CTL = TA0CCTL1 = 0;					// timer off, ov_cnt and TA0CCR1 are latched
+	// interrupts stay on from here, timer1 (uart) can't sit out the float math below
 
 
 #ifdef DEBUG
@@ -417,6 +563,7 @@ float measure_high_cap(uint8_t mode, float *esr) {
 		cx *= 285.83;					// my calibrated value using a 1nF 1%
 		if (charge_pin == PULSE_PIN)	// we are in high range
 			cx *= (47000.0/100.0);		// 100ohm instead of 47k
+		*range = charge_pin;			// remember what worked
 		charge_pin = 0;					// no more trials
 	}//else
 
@@ -450,6 +597,7 @@ float measure_high_cap(uint8_t mode, float *esr) {
 	uint16_t i=0;
 
 	for (i=0;i<256;i++) {
+		_BIC_SR(GIE);					// keep the pulse short
 		P1OUT |= PULSE_PIN; 			// current on
 		//__delay_cycles(16);			// 1us pulse? i don't see a difference, not used
 		P1DIR &= ~MEASURE_PIN;
@@ -460,6 +608,7 @@ float measure_high_cap(uint8_t mode, float *esr) {
 		//ADC10CTL0 ^= ADC10ON;
 		adc += ADC10MEM;
 		//__delay_cycles(32000);			// 1khz for me, could have been 1Khz, or 100Khz
+		_BIS_SR(GIE);					// current is off, timer1 can have its turn
 		__delay_cycles(16000);			// 1khz
 		//ADC10CTL0 ^= ADC10ON;
 	}//while
@@ -486,6 +635,16 @@ float measure_high_cap(uint8_t mode, float *esr) {
 
 }
 //________________________________________________________________________________
+static const char *const mode_sym[3] = { " -\1\1\1\1-", " --\2\3--", " --\2\4--", };
+
+#ifdef SCAN_CH
+typedef struct {
+	uint8_t mode, open, range;
+	uint16_t last_f3;
+	uint32_t x32;		// last value, high cap settle check
+} chan_t;
+#endif
+
 int main(void) {
 	WDTCTL = WDTPW + WDTHOLD;
 	BCSCTL1 = CALBC1_16MHZ;
@@ -497,16 +656,51 @@ int main(void) {
 
 	uint8_t c='=';
 	uint8_t cnt=0, wait=0, mode=9, last_open=0, open=0;
+	uint8_t pipe=0;		// a gate for the next reading is already running
+	uint8_t range=0;	// high cap charge pin that worked last
+
+	//______________ host command state
+	uint8_t host=0;		// host took over, no free-run
+	uint8_t shots=0;	// readings left in a single shot
+	uint8_t cal_step=0;	// 'm' before calibrated, take one calibration gate
+	uint8_t prec=1;		// readings averaged per single shot
+	uint8_t force=9, force_range=PULL_PIN;	// forced mode, 9 is auto detect
+	uint32_t t_req=0, t_shot=0, acc=0, acc_esr=0;	// t_shot, when the 'm' came in
+	uint8_t shot_n=0, shot_st=0, shot_mode=9;	// settled readings averaged, worst status, their mode
+
+	uart_setup();
+	_BIS_SR(GIE);		// timer1 runs the uart and the time stamp from here on
+
+#ifdef SCAN_CH
+	//______________ per channel cached state, calibrate w/ the fixture empty
+	static chan_t chan[SCAN_CH];
+	uint8_t ch=0;
+	for (ch=0;ch<SCAN_CH;ch++) chan[ch].mode = 9;
+	ch = 0;
+	P2DIR |= MUX_LATCH;
+	mux_select(ch);
+#endif
 
 	uint16_t f1=0, f2=0, f3=0, last_f3=0;
 
 	while (1) {
+		if (rx_c) {
+			//______________ host command, takes over whatever is going on
+			if (pipe) {
+				gate_stop();
+				pipe = 0;
+			}//if
+			c = rx_c == '=' ? '?' : rx_c;	// '=' is ours, not a host command
+			rx_c = 0;
+			t_req = rx_time;
+			host = 1;
+		}//if
 		if (c) {
 			switch (c) {
 				case '=':	// measure c
 					{
 					//__delay_cycles(MHZ*1000);
-					uint32_t x32=0;
+					uint32_t x32=0, raw=0;
 					float esr=0.0;
 					if (!f1) {
 						f1 = capture_pulses();
@@ -542,8 +736,25 @@ int main(void) {
 						else {
 							last_open = open;
 							open = 0;
-							x32 = measure_high_cap(mode, &esr);
-							if (x32) {
+#ifdef SCAN_CH
+							uint8_t lock = !last_open && mode <= 2;	// part type known on this channel
+#else
+							uint8_t lock = pipe;
+#endif
+							if (force <= 2) {		// host forced mode, skip auto detection
+								mode = force;
+								lock = 1;
+								if (mode == 2) range = force_range;
+							}//if
+#ifdef SCAN_CH
+							if (mode <= 2) eblcd_puts((char *) mode_sym[mode], 0);	// row 0 belongs to this channel now
+							else eblcd_clear(0);
+#endif
+							if (!lock) range = 0;
+							// no probing when lc part is known / lc reads are steady
+							x32 = (lock && mode <= 1) ? 0 : measure_high_cap(mode, &range, &esr);
+							_BIS_SR(GIE);			// presence probe returns w/ interrupts off
+							if (x32 || force == 2) {	// forced hi, nothing there reads open below
 								if (mode != 2) {
 									//eblcd_puts("Capacitance Hi", 0);
 									eblcd_puts(" --\2\4--", 0);
@@ -552,11 +763,26 @@ int main(void) {
 								last_f3 = 0;
 								if (x32 > 5000000000000.0)
 									open = 2;
+								if (lock && x32 < 10)	// did not probe, below 1nF means part's gone
+									open = 1;
+#ifdef SCAN_CH
+								if (lock && !open && force > 2 && chan[ch].x32) {
+									//__________ off by 1/8 from last value, part's changed or not settled
+									uint32_t d = x32 > chan[ch].x32 ? x32 - chan[ch].x32 : chan[ch].x32 - x32;
+									if (d > (chan[ch].x32>>3)) open = 2;
+								}//if
+#endif
 							}//if
 							else {
-								f3 = capture_pulses();
+								if (pipe) {
+									gate_wait();
+									f3 = capture_cnt;
+								}//if
+								else {
+									f3 = capture_pulses();
+								}//else
 								if (f3 < 20) {
-									if (mode != 0) {
+									if (mode != 0 && force > 2) {	// forced mode stays, it's just open
 										//eblcd_puts("Inductance", 0);
 										eblcd_puts(" -\1\1\1\1-", 0);
 										mode = 0;
@@ -565,7 +791,7 @@ int main(void) {
 									last_f3 = 0;
 								}//if
 								if ((f3>(f1-20)) && (f3<(f1+20))) {
-									if (mode != 1) {
+									if (mode != 1 && force > 2) {
 										//eblcd_puts("Capacitance", 0);
 										eblcd_puts(" --\2\3--", 0);
 										mode = 1;
@@ -586,6 +812,18 @@ int main(void) {
 									}//if
 								}//else
 							}//else
+							//______________ steady lc reading (next channel's in scan), start next gate now
+							//               this reading is converted and displayed while it runs
+#ifdef SCAN_CH
+							uint8_t nxt = (ch+1) < SCAN_CH ? ch+1 : 0;
+							// not past an out of range part, it gets discharged below before we move off
+							if ((pipe = (!host && open != 2 && chan[nxt].mode <= 1 && !chan[nxt].open))) {
+								mux_select(nxt);
+								gate_start();
+							}//if
+#else
+							if ((pipe = (mode <= 1 && !open && (!host || shots > 1)))) gate_start();
+#endif
 						}//else
 					}//if
 					//eblcd_write(0x80+8, 1); eblcd_dec16(f3/8);
@@ -623,6 +861,10 @@ int main(void) {
 
 
 
+#ifdef SCAN_CH
+						if (force > 2) chan[ch].x32 = x32;	// last value, before scaling for display
+#endif
+						raw = x32;
 						uint8_t dec=1, scale=0;
 						static const char x_unit[3] = { 'H', 'F', 'F', };
 						static const char x_scale[3][3] = {
@@ -673,17 +915,141 @@ int main(void) {
 
 					}//if
 
+					if (shots) {
+						//______________ host single shot, only settled readings of one part type are averaged
+						uint8_t st = 0;		// 0 K, 1 W, 2 O, 3 R
+						if (open) st = open == 2 ? 3 : 2;
+						if (last_open == 1 && open != 1) st = 1;	// first read after open
+						if (mode > 2) st = 2;
+						if (shot_n && mode != shot_mode) st = 1;	// part type changed mid shot
+						if (!st) {
+							shot_mode = mode;
+							shot_n++;
+							acc += raw;
+							acc_esr += esr;
+						}//if
+						if (st > shot_st) shot_st = st;
+					}//if
+					if (shots && !--shots) {
+						//______________ host single shot done, report average
+						_BIC_SR(GIE);
+						uint32_t t_done = time_stamp();
+						_BIS_SR(GIE);
+						uart_reply('m', t_shot);
+						uart_putc(','); uart_dec32(t_done>>1);
+						uart_putc(','); uart_dec32((t_done - t_shot)>>1);
+#ifdef SCAN_CH
+						uart_putc(','); uart_dec32(ch);
+#else
+						uart_puts(",0");
+#endif
+						uart_putc(','); uart_dec32(shot_n ? shot_mode : mode);
+						uart_putc(','); uart_putc("KWOR"[shot_st]);
+						uart_putc(','); uart_dec32(shot_n);
+						uart_putc(','); uart_dec32(shot_n ? acc/shot_n : 0);
+						uart_putc(','); uart_dec32(shot_n ? acc_esr/shot_n : 0);
+						uart_puts("\r\n");
+					}//if
+#ifdef SCAN_CH
+					if (f2 && !shots) {
+						//______________ keep this channel's state, move on to next one
+						eblcd_write(0x80+15, 1); eblcd_putc('1'+ch);
+						if (force > 2) {		// forced mode / range is the host's, not this part's
+							chan[ch].mode = mode;
+							chan[ch].range = range;
+						}//if
+						chan[ch].open = open;
+						chan[ch].last_f3 = last_f3;
+						if (open == 2) __delay_cycles(1000000);	// give the discharge some time
+						P1DIR &= ~(PULSE_PIN|MEASURE_PIN);		// let go before the mux moves on
+						if (++ch >= SCAN_CH) ch = 0;
+						mode = chan[ch].mode;
+						open = chan[ch].open;
+						range = chan[ch].range;
+						last_f3 = chan[ch].last_f3;
+						if (!pipe) mux_select(ch);	// already selected if gate is running
+					}//if
+#endif
 					}
 					break;
+				case 'm':	// host, single shot, measure now
+					if (f2) {
+						t_shot = t_req;		// other commands may come in while we are at it
+						shots = prec;
+						acc = acc_esr = 0;
+						shot_n = shot_st = 0;
+					}//if
+					else {
+						uart_reply(c, t_req);
+						uart_puts(",E\r\n");	// not calibrated yet
+						cal_step = 1;			// free-run is off, walk calibration one gate per 'm'
+					}//else
+					break;
+				case 'a':	// host, auto detect
+				case 'l':	// host, force inductance
+				case 'c':	// host, force capacitance
+				case 'h':	// host, force capacitance hi, from 47k range
+				case 'H':	// host, force capacitance hi, 100ohm range
+					force = c == 'a' ? 9 : c == 'l' ? 0 : c == 'c' ? 1 : 2;
+					force_range = c == 'H' ? PULSE_PIN : PULL_PIN;
+					if (force <= 2) eblcd_puts((char *) mode_sym[force], 0);
+					uart_reply(c, t_req);
+					uart_puts("\r\n");
+					break;
+				case 'f':	// host, back to free-run
+					host = 0;
+					uart_reply(c, t_req);
+					uart_puts("\r\n");
+					break;
 				case 'x': // filter on-off
 					CACTL2 ^= CAF;
+					uart_reply(c, t_req);
+					uart_puts("\r\n");
+					break;
+				default:
+					if (c >= '1' && c <= '9') {		// host, readings per single shot
+						prec = c - '0';
+						uart_reply(c, t_req);
+						uart_puts("\r\n");
+					}//if
+					else if (c > ' ') {
+						uart_reply('?', t_req);
+						uart_puts("\r\n");
+					}//if
 					break;
 
 			}//switch
 			c = 0;
 		}//if
 
-		if (!++cnt) {
+		if (shots) {
+			P1DIR &= ~PULSE_PIN;	// disconnect, same as a free-run reading
+			c = '=';				// host single shot, more readings to go
+		}//if
+		else if (cal_step) {
+			cal_step = 0;
+			P1DIR &= ~PULSE_PIN;
+			c = '=';				// one calibration gate, open leads / calibrate pressed
+		}//if
+		else if (host) {
+			//______________ host mode, sleep till next command
+			_BIC_SR(GIE);
+			while (!rx_c) {
+				_BIS_SR(LPM0_bits + GIE);
+				_BIC_SR(GIE);
+			}//while
+			_BIS_SR(GIE);
+		}//if
+		else if (pipe) {
+			c = '=';				// gate in flight, pick it up as soon as it latches
+		}//if
+#ifdef SCAN_CH
+		else if (f2) {
+			P1DIR &= ~PULSE_PIN;	// disconnect
+			c = '=';				// fixture scan, next channel right away
+		}//if
+#endif
+		else if (!++cnt) {
 			P1DIR &= ~PULSE_PIN;	// disconnect
 			c = '=';				// change state to take reading
 		}//if
@@ -691,7 +1057,7 @@ int main(void) {
 			//P1DIR |= PULSE_PIN|MEASURE_PIN;		// use chance to discharge large caps
 			//P1OUT &= ~(PULSE_PIN|MEASURE_PIN);		
 		}//else
-		__delay_cycles(50000);
+		if (!host) __delay_cycles(50000);
 
 	}//while
 
@@ -704,17 +1070,63 @@ __interrupt void TIMER0_A1_ISR(void) {
 	switch (TA0IV) {
 		case 10:
 			ov_cnt++;
+			if (gate_busy) {		// end of pulse counting gate, latch
+				CACTL1 &= ~CAIE;
+				TA0CTL = 0;
+				gate_busy = 0;
+			}//if
 			//__bic_SR_register_on_exit(LPM0_bits|GIE);
 			__bic_SR_register_on_exit(LPM0_bits);
 			break;
 	}//swtich
 }
 
+//________________________________________________________________________________
+#pragma vector=TIMER0_A0_VECTOR
+__interrupt void TIMER0_A0_ISR(void) {
+	TA0CCTL0 = 0;				// charge phase over, open gate for a full timerA period
+	TA0CTL |= TACLR|TAIE;		// need overflow interrupt
+	CACTL1 |= CAIE;				// comparator interrupt on, count pulses from our LC tank
+}
+
+//________________________________________________________________________________
+#pragma vector=TIMER1_A1_VECTOR
+__interrupt void TIMER1_A1_ISR(void) {
+	switch (TA1IV) {
+		case 2:		// uart rx
+			TA1CCR1 += UART_TBIT;
+			if (TA1CCTL1 & CAP) {		// start bit, sample data bits in the middle
+				TA1CCTL1 &= ~CAP;
+				TA1CCR1 += UART_TBIT/2;
+			}//if
+			else {
+				rx_data >>= 1;
+				if (TA1CCTL1 & SCCI) rx_data |= 0x80;
+				if (!--rx_bits) {
+					rx_c = rx_data;
+					rx_time = time_stamp();
+					rx_bits = 8;
+					TA1CCTL1 |= CAP;		// wait for next start bit
+					__bic_SR_register_on_exit(LPM0_bits);
+				}//if
+			}//else
+			break;
+		case 10:	// overflow, time stamp
+			ticks++;
+			break;
+	}//switch
+}
+
 //________________________________________________________________________________
 #pragma vector=COMPARATORA_VECTOR
 __interrupt void COMPARATORA_ISR(void) {
 	capture_cnt++;
-	if (capture_cnt > 0x8000) __bic_SR_register_on_exit(LPM0_bits|GIE);
+	if (capture_cnt > 0x8000) {		// too many, close gate early
+		CACTL1 &= ~CAIE;
+		TA0CTL = 0;
+		gate_busy = 0;
+		__bic_SR_register_on_exit(LPM0_bits);
+	}//if
 }
 /*
 //________________________________________________________________________________
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+lc_host, host side stand-in for the lc_meter command interface
+
+starts lcsim in pty mode, talks to the firmware uart over the pseudo terminal
+the way a test station would, and checks every reply. lcsim's log has the
+time each command byte was on the wire, so the meter's own time stamps
+(t_rx, t_done) are checked against it too.
+
+  python3 lc_host.py [path/to/lcsim]
+"""
+
+import os
+import select
+import subprocess
+import sys
+import tempfile
+import time
+import tty
+
+BIT_US = 1e6 / 9600
+T_WRAP = 1 << 31        # meter time stamps are us mod 2^31
+WRAP_S = 2              # have lcsim wrap them this far into the run
+
+
+class Fail(Exception):
+    pass
+
+
+class Meter:
+    def __init__(self, sim, log):
+        self.p = subprocess.Popen([sim, '-l', log, '-w', str(WRAP_S), 'pty'], stdin=subprocess.PIPE,
+                                  stdout=subprocess.PIPE, text=True, bufsize=1)
+        line = self.p.stdout.readline().split()
+        if len(line) != 2 or line[0] != 'pty:':
+            raise Fail('lcsim did not come up w/ a pty')
+        self.fd = os.open(line[1], os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.buf = b''
+        self.sent = []
+        self.replies = []
+        self.t0 = {}
+        self.t_last = None
+
+    def ctl(self, line):
+        """sim side, ie. press calibrate or mount a part"""
+        self.p.stdin.write(line + '\n')
+        self.p.stdin.flush()
+        ack = self.p.stdout.readline().strip()
+        if ack != 'ok ' + line:
+            raise Fail('lcsim: %r to %r' % (ack, line))
+
+    def send(self, c):
+        self.t0[c] = time.monotonic()
+        self.sent.append(c)
+        os.write(self.fd, c.encode())
+
+    def reply(self, c, timeout=5.0):
+        """next reply line, to command c, split on ','"""
+        t0 = self.t0[c]
+        while b'\r\n' not in self.buf:
+            left = timeout - (time.monotonic() - t0)
+            r = select.select([self.fd], [], [], max(left, 0))[0]
+            if not r:
+                raise Fail('no reply to %r' % c)
+            self.buf += os.read(self.fd, 256)
+        line, self.buf = self.buf.split(b'\r\n', 1)
+        rtt = time.monotonic() - t0
+        f = line.decode().split(',')
+        print('  %-3r -> %-48s %6.0fms' % (c, line.decode(), rtt * 1000))
+        if len(f) < 2 or not f[1].isdigit():
+            raise Fail('bad reply %r' % line)
+        f[1] = str(self.unwrap(int(f[1])))
+        if f[0] == 'm' and len(f) == 10:
+            f[2] = str(self.unwrap(int(f[2])))
+        self.replies.append((c, f))
+        return f
+
+    def unwrap(self, t):
+        """meter time stamp, taken closest to the last one seen"""
+        if self.t_last is not None:
+            t += (self.t_last - t + T_WRAP // 2) // T_WRAP * T_WRAP
+        self.t_last = t
+        return t
+
+    def cmd(self, c, timeout=5.0):
+        """one command byte, one reply line back"""
+        self.send(c)
+        return self.reply(c, timeout)
+
+    def close(self):
+        self.p.stdin.write('quit\n')
+        self.p.stdin.flush()
+        out = self.p.stdout.read().strip()
+        print('  lcsim: ' + out.replace('\n', '\n  lcsim: '))
+        rc = self.p.wait(5)
+        os.close(self.fd)
+        if rc:
+            raise Fail('lcsim exit %d' % rc)
+
+
+def expect(cond, what):
+    if not cond:
+        raise Fail(what)
+
+
+def near(v, want, tol):
+    return abs(v - want) <= want * tol
+
+
+def reading(f, mode, st, n):
+    """m,t_rx,t_done,latency,ch,mode,status,n,value,esr"""
+    expect(len(f) == 10 and f[0] == 'm', 'reading has 10 fields')
+    t_rx, t_done, lat = int(f[1]), int(f[2]), int(f[3])
+    expect(abs(lat - (t_done - t_rx)) <= 1, 'latency is t_done - t_rx')   # 0.5us stamps, halved apart
+    expect(int(f[5]) == mode, 'mode %s, want %d' % (f[5], mode))
+    expect(f[6] == st, 'status %s, want %s' % (f[6], st))
+    expect(int(f[7]) == n, '%s readings averaged, want %d' % (f[7], n))
+    return int(f[8]), int(f[9]), lat
+
+
+def check_log(m, log):
+    """meter time stamps vs when lcsim had the bytes on the wire"""
+    rx, tx = [], []
+    for l in open(log):
+        w = l.split()
+        if w[0] == 'rx':
+            rx.append((w[1], float(w[2])))
+        elif w[0] == 'tx':
+            tx.append(float(w[1]))
+    expect(len(rx) == len(m.replies) and len(tx) == len(m.replies), 'log has every command and reply')
+    # replies can come out of order (commands during a shot), t_rx puts them back
+    by_rx = sorted(m.replies, key=lambda r: int(r[1][1]))
+    expect([c for c, f in by_rx] == m.sent, 't_rx in the order commands were sent')
+    offs = []
+    for (c, f), (rc, start) in zip(by_rx, rx):
+        expect(rc == c, 'log order')
+        # t_rx is taken at the last data bit, 8.5 bit times into the frame
+        offs.append(int(f[1]) - (start + 8.5 * BIT_US))
+    spread = max(offs) - min(offs)
+    print('  time stamps vs wire: offset %.0fus, spread %.0fus over %d commands' % (offs[0], spread, len(offs)))
+    expect(spread < 100, 'meter clock lost time (timer1 overflow missed?)')
+    expect(int(by_rx[-1][1][1]) > T_WRAP, 'time stamps never wrapped, -w')
+    for (c, f), t_line in zip(m.replies, tx):
+        if f[0] == 'm' and len(f) == 10:
+            done = int(f[2]) - offs[0]
+            expect(0 <= t_line - done < 5000, 't_done %.0fus before the reply went out' % (t_line - done))
+
+
+def run(sim):
+    log = tempfile.mktemp(prefix='lcsim_', suffix='.log')
+    m = Meter(sim, log)
+    try:
+        time.sleep(1.0)                         # boot banner
+        print('not calibrated, each m takes a calibration gate')
+        for i in range(2):                      # open leads, f1 in
+            f = m.cmd('m')
+            expect(len(f) == 3 and f[2] == 'E', 'm before calibrate is E')
+            time.sleep(0.1)
+        m.ctl('cal')
+        f = m.cmd('m')                          # calibrate held for this one
+        expect(len(f) == 3 and f[2] == 'E', 'm before calibrate is E')
+        time.sleep(0.1)
+
+        print('empty socket')
+        reading(m.cmd('m'), 1, 'O', 0)
+
+        print('C 220p, 3 readings, first one after open is not settled')
+        m.ctl('mount C 220p')
+        expect(m.cmd('3')[0] == '3', '3')
+        v, esr, lat = reading(m.cmd('m'), 1, 'W', 2)
+        expect(near(v, 2200, 0.05), 'C %d, want 2200 (0.1pF)' % v)
+        expect(40000 < lat < 400000, 'latency %dus' % lat)
+        v, esr, lat = reading(m.cmd('m'), 1, 'K', 3)
+        expect(near(v, 2200, 0.05), 'C %d, want 2200 (0.1pF)' % v)
+        expect(m.cmd('c')[0] == 'c', 'c')
+        v, esr, lat = reading(m.cmd('m'), 1, 'K', 3)
+        expect(near(v, 2200, 0.05), 'forced C %d' % v)
+        print('command during a shot')
+        m.send('m')
+        time.sleep(0.05)
+        x = m.cmd('3')
+        f = m.reply('m')
+        v, esr, lat = reading(f, 1, 'K', 3)
+        expect(int(f[1]) < int(x[1]) and lat > int(f[2]) - int(x[1]), 'shot keeps the t_rx of its m')
+        expect(m.cmd('x')[0] == 'x', 'x')
+        expect(m.cmd('x')[0] == 'x', 'x')
+
+        print('H 10u 0.5ohm, forced hi range')
+        m.ctl('mount H 10u 0.5')
+        expect(m.cmd('h')[0] == 'h', 'h')
+        expect(m.cmd('1')[0] == '1', '1')
+        v, esr, lat = reading(m.cmd('m', 10), 2, 'K', 1)
+        expect(near(v, 100000, 0.05), 'H %d, want 100000 (0.1nF)' % v)
+        expect(near(esr, 50, 0.3), 'esr %d, want ~50 (0.01ohm)' % esr)
+        expect(100000 < lat < 1500000, 'latency %dus' % lat)
+
+        print('L 10u, forced')
+        m.ctl('mount L 10u')
+        expect(m.cmd('l')[0] == 'l', 'l')
+        v, esr, lat = reading(m.cmd('m'), 0, 'K', 1)
+        expect(near(v, 100000, 0.05), 'L %d, want 100000 (0.1nH)' % v)
+
+        print('forced modes stay, read open w/ nothing there')
+        m.ctl('mount L')
+        expect(m.cmd('c')[0] == 'c', 'c')
+        reading(m.cmd('m'), 1, 'O', 0)
+        m.ctl('mount H')
+        expect(m.cmd('h')[0] == 'h', 'h')
+        reading(m.cmd('m'), 2, 'O', 0)
+
+        print('back to auto, unknown commands')
+        expect(m.cmd('a')[0] == 'a', 'a')
+        expect(m.cmd('=')[0] == '?', '= is not a command')
+        expect(m.cmd('z')[0] == '?', 'z')
+        expect(m.cmd('f')[0] == 'f', 'f')
+    finally:
+        m.close()
+    try:
+        check_log(m, log)               # lcsim's gone, log is complete
+    finally:
+        os.unlink(log)
+
+
+if __name__ == '__main__':
+    try:
+        run(sys.argv[1] if len(sys.argv) > 1 else './lcsim')
+    except Fail as e:
+        print('FAIL: %s' % e)
+        sys.exit(1)
+    print('ok')
@@ -0,0 +1,1123 @@
+/*
+
+lcsim
+=====
+
+host side stand-in for the lc_meter board. lc_meter.c is built unchanged
+against sim/msp430.h, every register access lands here, where a small event
+driven model of the g2553 (timer0/1, comparator_a+, adc10, port pins) and of
+the analog front end (LC tank, high cap node, lcd / mux shift lines) runs
+the firmware in simulated time at 16MHz.
+
+time only moves on register access (ACCESS_CYCLES each), __delay_cycles(),
+ISR entry / exit and LPM0 sleep. soft-float math and plain C in between is
+not charged, -f bills a fixed conversion time whenever a reading goes to
+lcd row 1 instead.
+
+  lcsim [-t secs] [-f ms] [-v] trace [part]
+  lcsim_scan [-t secs] [-v] [-s ch:part@secs] scan [parts]
+  lcsim [-l log] [-w secs] [-v] pty
+
+  trace   single DUT, free-run, log every pulse counting gate (see README)
+  scan    SCAN_CH build, one part per fixture channel, report what each
+          reading cost (gates, charge trials, vcc referenced adc reads ie.
+          presence probe, flat check, discharge) and parts per minute once
+          every channel has been read twice. -s swaps a part, secs after
+          the parts went in
+  pty     free-run in wall time, firmware uart on a pseudo terminal, stdin
+          takes cal / mount <socket> [value [esr]] / quit, see lc_host.py.
+          fails if the firmware keeps interrupts off for a rx bit time.
+          -w has the firmware time stamp wrap secs after the uart is up
+
+either one fails if a gate counts w/ the pulse or measure pin (P1.2, P1.4)
+driven, the tank would see it.
+
+calibrate is pressed for the 2nd gate (L leads shorted for the first two),
+parts go in after one more pass w/ the sockets empty.
+
+parts are <socket>[:<value>[:<esr>]], socket L (in series w/ tank coil),
+C (across tank cap) or H (high cap on P1.4), value w/ p n u m suffix, ie.
+C:220p L:10u H:47u:0.3, a high cap can come precharged, ie. H:2200u:0.1:3
+for 3V. a socket w/o value is an empty one.
+
+*/
+//______________________________________________________________________________
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE	600
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "msp430.h"
+
+#define CPU_HZ			16000000.0
+#define NEVER			UINT64_MAX
+#define ACCESS_CYCLES	3
+#define MS(c)			((double) (c) * 1000.0 / CPU_HZ)
+#define US(c)			((double) (c) * 1000000.0 / CPU_HZ)
+
+#define VCC			3.3
+#define VPULSE		3.0			// pulse pin high w/ ~30mA drawn
+#define R_PULL		47000.0
+#define R_PULSE		140.0		// 100ohm + pin, what the esr calibration works out to
+#define R_PIN		40.0
+#define L0			82e-6		// tank
+#define C0			1e-9
+#define C_CAL		1e-9		// calibrate button
+#define C_STRAY		20e-12		// empty high cap socket
+#define V_CAREF		0.55
+#define ADC_FLOAT	84			// open P1.4 reads ~0.27V
+
+#ifdef SCAN_CH
+#define NCH			SCAN_CH
+#else
+#define NCH			1
+#endif
+
+void TIMER0_A0_ISR(void);
+void TIMER0_A1_ISR(void);
+void TIMER1_A1_ISR(void);
+void COMPARATORA_ISR(void);
+int fw_main(void);
+extern volatile uint16_t capture_cnt, ticks;
+
+//______________________________________________________________________________
+static uint64_t now, end_time=NEVER;
+static uint8_t r8[SIM_R8_N], s8[SIM_R8_N];
+static uint16_t r16[SIM_R16_N], s16[SIM_R16_N];
+static int gie, in_isr, woke, isr_gie_off, verbose, fails;
+static int pty_fd=-1, ctl_fd=-1;
+static FILE *log_fp;
+static uint32_t rx_total, tx_total;
+static uint64_t fcost, fcost_due;
+static uint64_t gie_off_t, gie_off_max;
+
+static void fatal(const char *msg) {
+	fprintf(stderr, "lcsim: %.3fms: %s\n", MS(now), msg);
+	exit(2);
+}
+
+static void hw8(int r, uint8_t v) { r8[r] = s8[r] = v; }
+static void hw16(int r, uint16_t v) { r16[r] = s16[r] = v; }
+
+//______________________________________________________________________________
+// devices under test
+typedef struct {
+	char sock;			// 'L', 'C', 'H'
+	double val, esr;	// 0 val is an empty socket
+	double vc;			// charge left on the high cap node
+	char name[16];
+} part_t;
+
+static part_t spec[NCH], dut[NCH];
+static int sel, cal_on, l_short, mounted;
+static uint8_t sr595, latch595;
+
+static double parse_val(const char *p) {
+	char *e;
+	double v = strtod(p, &e);
+	switch (*e) {
+		case 'p': v *= 1e-12; break;
+		case 'n': v *= 1e-9; break;
+		case 'u': v *= 1e-6; break;
+		case 'm': v *= 1e-3; break;
+	}//switch
+	return v;
+}
+
+static void parse_part(part_t *p, const char *s) {
+	memset(p, 0, sizeof(*p));
+	snprintf(p->name, sizeof(p->name), "%s", s);
+	p->sock = s[0];
+	if (!strchr("LCH", p->sock)) fatal("part socket must be L, C or H");
+	if ((s = strchr(s, ':'))) {
+		p->val = parse_val(++s);
+		if ((s = strchr(s, ':'))) p->esr = atof(++s);
+		if (s && (s = strchr(s, ':'))) p->vc = atof(++s);
+	}//if
+}
+
+static void mount(void) {
+	int i;
+	for (i=0;i<NCH;i++) {
+		double vc = dut[i].vc;
+		dut[i] = spec[i];
+		if (!spec[i].vc) dut[i].vc = vc;
+	}//for
+	mounted = 1;
+}
+
+static double f_tank(void) {
+	part_t *p = &dut[sel];
+	double L = L0, C = C0 + (cal_on ? C_CAL : 0.0);
+	if (p->sock == 'L') {
+		if (p->val <= 0.0 && !l_short) return 0.0;		// series socket open, no oscillation
+		L += p->val;
+	}//if
+	if (p->sock == 'C') C += p->val;
+	return 1.0 / (2.0 * M_PI * sqrt(L * C));
+}
+
+//______________________________________________________________________________
+// high cap node on P1.4, charged / discharged thru the pull, pulse and measure pins
+static double node_c(void) {
+	part_t *p = &dut[sel];
+	return (p->sock == 'H' && p->val > 0.0) ? p->val : C_STRAY;
+}
+
+static void node_drive(double *g, double *vinf) {
+	double gs=0.0, is=0.0;
+	uint8_t dir = r8[SIM_P1DIR] & ~r8[SIM_P1SEL], out = r8[SIM_P1OUT];
+	if (dir & BIT3) { gs += 1/R_PULL; is += (out & BIT3 ? VCC : 0.0)/R_PULL; }
+	if (dir & BIT2) { gs += 1/R_PULSE; is += (out & BIT2 ? VPULSE : 0.0)/R_PULSE; }
+	if (dir & BIT4) { gs += 1/R_PIN; is += (out & BIT4 ? VCC : 0.0)/R_PIN; }
+	*g = gs;
+	*vinf = gs > 0.0 ? is/gs : 0.0;
+}
+
+static void node_step(uint64_t dt) {
+	double g, vinf;
+	node_drive(&g, &vinf);
+	if (g <= 0.0) return;
+	part_t *p = &dut[sel];
+	p->vc = vinf + (p->vc - vinf) * exp(-(dt/CPU_HZ) * g / node_c());
+}
+
+//______________________________________________________________________________
+// comparator, either the LC tank oscillator or the 0.55V high cap trip point
+static double osc_next;
+static int osc_on, cmp_out=1;
+
+static int lc_active(void) {
+	return (r8[SIM_CACTL1] & CAON) && (r8[SIM_CACTL2] & (P2CA4|P2CA3|P2CA2)) == (P2CA4|P2CA3|P2CA2);
+}
+
+static int hc_active(void) {
+	return (r8[SIM_CACTL1] & CAON) && (r8[SIM_CACTL1] & (CAREF_2|CAREF_1))
+		&& (r8[SIM_CACTL2] & (P2CA4|P2CA3|P2CA2)) == P2CA3;
+}
+
+static uint64_t hc_cross(void) {
+	if (!hc_active()) return NEVER;
+	double g, vinf, v0 = dut[sel].vc;
+	node_drive(&g, &vinf);
+	if (g <= 0.0) return NEVER;
+	if (cmp_out ? (vinf <= V_CAREF || v0 >= V_CAREF) : (vinf >= V_CAREF || v0 <= V_CAREF)) return NEVER;
+	double t = (node_c()/g) * log((vinf - v0)/(vinf - V_CAREF));
+	return now + (uint64_t) ceil(t * CPU_HZ);
+}
+
+//______________________________________________________________________________
+// pulse counting gates as seen on the pins, for the trace
+typedef struct {
+	uint64_t start, open, ovf, close, sleep, pre, post;
+	uint16_t fw;
+	uint32_t edges;
+	int ch, part;
+	uint8_t held;				// P1.2 / P1.4 driven while counting, the tank sees them
+} gate_t;
+
+#define MAX_GATES	20000
+static gate_t gates[MAX_GATES];
+static int ngates, gate_total, gate_live, last_closed=-1, gate_wrap;
+static int cal_auto=1, cal_req;
+static uint32_t ch_gates[NCH], gates_held;
+static uint64_t mount_t;
+static uint64_t idle_end;
+
+//______________________________________________________________________________
+// timer_a, continuous mode only, that's all the firmware uses
+static uint32_t tfrac[2];
+
+static int tb(int t) { return t ? SIM_TA1CTL : SIM_TA0CTL; }
+static uint32_t tdiv(int t) { return 1u << ((r16[tb(t)] >> 6) & 3); }
+static int trun(int t) { return (r16[tb(t)] & MC_3) == MC_2; }
+
+static uint64_t timer_next(int t) {
+	int b = tb(t), n;
+	uint16_t R = r16[b+1];
+	uint32_t d = 0x10000 - R;
+	for (n=0;n<3;n++) {
+		if (r16[b+2+n] & CAP) continue;
+		uint32_t dn = (uint16_t) (r16[b+5+n] - R);
+		if (!dn) dn = 0x10000;
+		if (dn < d) d = dn;
+	}//for
+	return (uint64_t) d * tdiv(t) - tfrac[t];
+}
+
+static int timer_cci(int t, int n) {
+	uint16_t c = r16[tb(t)+2+n];
+	int rxd_level(void);
+	if (t == 1 && n == 1 && !(c & CCIS_1)) return rxd_level();
+	if (t == 0 && n == 1 && (c & CCIS_1)) return cmp_out;
+	return 0;
+}
+
+static void txd_set(int level);
+
+static void timer_compare(int t, int n) {
+	int b = tb(t);
+	uint16_t c = r16[b+2+n] | CCIFG;
+	c = timer_cci(t, n) ? (c | SCCI) : (c & ~SCCI);
+	hw16(b+2+n, c);
+	if (t == 1 && n == 0) {				// TA1.0 output unit drives TXD
+		uint16_t mode = c & 0x00E0;
+		if (mode == OUTMOD_1) txd_set(1);
+		if (mode == OUTMOD_5) txd_set(0);
+	}//if
+}
+
+static void timer_capture(int t, int n, int rising) {
+	int b = tb(t);
+	uint16_t c = r16[b+2+n];
+	if (!trun(t) || !(c & CAP)) return;
+	if (!(c & (rising ? CM_1 : CM_2))) return;
+	hw16(b+5+n, r16[b+1]);
+	if (c & CCIFG) c |= COV;
+	hw16(b+2+n, c | CCIFG);
+}
+
+static void timer_step(int t, uint64_t dt) {
+	int b = tb(t), n;
+	uint64_t tot = tfrac[t] + dt;
+	uint32_t nt = tot / tdiv(t);
+	tfrac[t] = tot % tdiv(t);
+	if (!nt) return;
+	uint32_t R = r16[b+1];
+	hw16(b+1, (R + nt) & 0xffff);
+	for (n=0;n<3;n++) {
+		if (r16[b+2+n] & CAP) continue;
+		uint32_t dn = (uint16_t) (r16[b+5+n] - R);
+		if (!dn) dn = 0x10000;
+		if (dn == nt) timer_compare(t, n);
+	}//for
+	if (R + nt >= 0x10000) {
+		hw16(b, r16[b] | TAIFG);
+		if (!t && gate_live && gates[ngates-1].open && !gates[ngates-1].ovf) gates[ngates-1].ovf = now;
+	}//if
+}
+
+static uint16_t timer_iv(int t) {
+	int b = tb(t);
+	if ((r16[b+3] & (CCIE|CCIFG)) == (CCIE|CCIFG)) { hw16(b+3, r16[b+3] & ~CCIFG); return 2; }
+	if ((r16[b+4] & (CCIE|CCIFG)) == (CCIE|CCIFG)) { hw16(b+4, r16[b+4] & ~CCIFG); return 4; }
+	if ((r16[b] & (TAIE|TAIFG)) == (TAIE|TAIFG)) { hw16(b, r16[b] & ~TAIFG); return 10; }
+	return 0;
+}
+
+static int timer_a1_pending(int t) {
+	int b = tb(t);
+	return (r16[b+3] & (CCIE|CCIFG)) == (CCIE|CCIFG)
+		|| (r16[b+4] & (CCIE|CCIFG)) == (CCIE|CCIFG)
+		|| (r16[b] & (TAIE|TAIFG)) == (TAIE|TAIFG);
+}
+
+//______________________________________________________________________________
+// adc10, only INCH_4 (P1.4) is used
+static uint64_t adc_done=NEVER;
+static uint16_t adc_val;
+static uint32_t adc_probes[NCH], ch_trials[NCH];	// vcc referenced reads (presence probe, flat check), charge trials
+
+static uint16_t adc_sample(void) {
+	part_t *p = &dut[sel];
+	double v;
+	if (!(r16[SIM_ADC10CTL0] & REFON)) adc_probes[sel]++;
+	if (!(p->sock == 'H' && p->val > 0.0) && !((r8[SIM_P1DIR] & BIT4) && !(r8[SIM_P1SEL] & BIT4)))
+		return ADC_FLOAT;				// nothing on the pin and not driven either
+	if (r16[SIM_ADC10CTL0] & REFON) {
+		// esr pulses, the inverse of the firmware's own calibration curve
+		double mv = p->vc * 1000.0;
+		if ((r8[SIM_P1DIR] & BIT2) && (r8[SIM_P1OUT] & BIT2) && p->sock == 'H')
+			mv += 3000.0 * p->esr / (140.0 + p->esr);
+		v = mv * 1024.0 / 1500.0;
+	}//if
+	else {
+		v = p->vc / VCC * 1023.0;
+	}//else
+	if (v > 1023.0) v = 1023.0;
+	return (uint16_t) (v + 0.5);
+}
+
+static void adc_start(void) {
+	if (!(r16[SIM_ADC10CTL0] & ADC10ON)) return;
+	if ((r16[SIM_ADC10CTL1] & 0xF000) != INCH_4) fatal("adc channel other than INCH_4");
+	adc_val = adc_sample();
+	adc_done = now + ((r16[SIM_ADC10CTL0] & ADC10SHT_2) ? 93 : 67);	// sample + 13 adc10osc clocks
+	hw16(SIM_ADC10CTL1, r16[SIM_ADC10CTL1] | ADC10BUSY);
+}
+
+//______________________________________________________________________________
+// uart lines, host side runs at exact 9600
+#define HOST_TBIT	(CPU_HZ/9600.0)
+
+typedef struct { uint8_t b; uint64_t start; } rx_t;
+static rx_t rxq[256];
+static int rx_head, rx_tail;
+
+int rxd_level(void) {
+	int i;
+	for (i=rx_head;i!=rx_tail;i=(i+1)&255) {
+		if (now < rxq[i].start) break;
+		int bit = (int) ((now - rxq[i].start) / HOST_TBIT);
+		if (bit >= 10) continue;
+		if (!bit) return 0;
+		if (bit == 9) return 1;
+		return (rxq[i].b >> (bit-1)) & 1;
+	}//for
+	return 1;
+}
+
+static uint64_t rx_next_edge(void) {
+	int i, k;
+	while (rx_head != rx_tail && now >= rxq[rx_head].start + (uint64_t) (10*HOST_TBIT)) rx_head = (rx_head+1)&255;
+	for (i=rx_head;i!=rx_tail;i=(i+1)&255) {
+		int last = 1;
+		for (k=0;k<10;k++) {
+			int lvl = !k ? 0 : k == 9 ? 1 : (rxq[i].b >> (k-1)) & 1;
+			uint64_t t = rxq[i].start + (uint64_t) ceil(k*HOST_TBIT);
+			if (last && !lvl && t > now) return t;
+			last = lvl;
+		}//for
+	}//for
+	return NEVER;
+}
+
+static uint64_t rx_send(uint8_t b) {
+	uint64_t start = now + 16;
+	if (rx_head != rx_tail) {
+		uint64_t end = rxq[(rx_tail-1)&255].start + (uint64_t) ceil(10*HOST_TBIT);
+		if (end > start) start = end;
+	}//if
+	rxq[rx_tail].b = b;
+	rxq[rx_tail].start = start;
+	rx_tail = (rx_tail+1)&255;
+	return start;
+}
+
+static int txd=1, tx_busy, tx_bit;
+static uint64_t tx_start;
+static uint16_t tx_data;
+static void tx_byte(uint8_t b);
+
+static void tx_flush(void) {
+	while (tx_busy) {
+		uint64_t ts = tx_start + (uint64_t) ((tx_bit + 0.5) * HOST_TBIT);
+		if (ts > now) break;
+		if (!tx_bit && txd) tx_busy = 0;		// glitch, not a start bit
+		else if (tx_bit == 9) {
+			tx_busy = 0;
+			if (!txd) fatal("uart framing error on TXD");
+			tx_byte(tx_data);
+		}//if
+		else if (tx_bit) tx_data |= txd << (tx_bit-1);
+		tx_bit++;
+	}//while
+}
+
+static void txd_set(int level) {
+	if (!((r8[SIM_P2SEL] & r8[SIM_P2DIR]) & BIT0)) level = 1;
+	tx_flush();
+	if (!tx_busy && txd && !level) {
+		tx_busy = 1;
+		tx_bit = 0;
+		tx_data = 0;
+		tx_start = now;
+	}//if
+	txd = level;
+}
+
+static char tx_line[128];
+static int tx_len;
+static uint64_t tx_line_t;
+
+static void tx_byte(uint8_t b) {
+	if (pty_fd >= 0 && write(pty_fd, &b, 1) != 1) fatal("pty write");
+	if (!tx_len) tx_line_t = tx_start;
+	if (b == '\r') return;
+	if (b == '\n' || tx_len == sizeof(tx_line)-1) {
+		tx_line[tx_len] = 0;
+		if (verbose) printf("%10.3fms uart> %s\n", MS(tx_line_t), tx_line);
+		if (log_fp) fprintf(log_fp, "tx %.1f %s\n", US(tx_line_t), tx_line);
+		tx_total++;
+		tx_len = 0;
+		return;
+	}//if
+	tx_line[tx_len++] = b;
+}
+
+static void scan_done(int c);
+
+//______________________________________________________________________________
+// lcd on the CLK / DATA shift lines, the 74hc595 of the fixture mux sits on them too
+static uint8_t lcd_sr, lcd_bits, lcd_addr, lcd_cg;
+static char lcd[2][17];
+static int row1_gate=-1, row1_steady;
+static uint32_t row1_writes;
+static uint64_t row1_first, row1_last;
+
+static void lcd_byte(uint8_t b, int data) {
+	if (!data) {
+		if (b & 0x80) {
+			lcd_addr = b & 0x7f;
+			lcd_cg = 0;
+			if (lcd_addr == 0x40 && row1_gate != last_closed) {
+				row1_gate = last_closed;	// 1st row 1 write after a latched count
+				fcost_due = fcost;			// conversion is done by the time a reading is shown
+				if (!row1_writes++) row1_first = now;
+				row1_last = now;
+			}//if
+		}//if
+		else if ((b & 0xc0) == 0x40) lcd_cg = 1;
+		else if (b == 0x01) { memset(lcd, ' ', sizeof(lcd)); lcd[0][16] = lcd[1][16] = 0; lcd_addr = 0; }
+		return;
+	}//if
+	if (lcd_cg) return;
+	if (lcd_addr == 15 && b >= '1' && b < '1' + NCH) scan_done(b - '1');	// channel done, row 1 is its reading
+	static const char glyph[] = "#n||]^vO";
+	char c = b < 8 ? glyph[b] : (char) b;
+	if (lcd_addr < 16) lcd[0][lcd_addr] = c;
+	else if (lcd_addr >= 0x40 && lcd_addr < 0x50) lcd[1][lcd_addr-0x40] = c;
+	lcd_addr++;
+}
+
+static void shift_clk(void) {
+	int d = (r8[SIM_P1OUT] & BIT7) ? 1 : 0;
+	sr595 = (sr595 << 1) | d;
+	lcd_sr = (lcd_sr << 1) | d;
+	if (++lcd_bits == 8) {
+		lcd_bits = 0;
+		lcd_byte(lcd_sr, r8[SIM_P2OUT] & BIT3);
+	}//if
+}
+
+
+static void gate_started(void) {
+	if (ngates == MAX_GATES) {
+		if (!gate_wrap) fatal("too many gates");
+		ngates = 0;					// nobody reads the gate log, keep going
+		last_closed = -1;
+	}//if
+	gate_total++;
+	gate_t *g = &gates[ngates++];
+	memset(g, 0, sizeof(*g));
+	g->start = now;
+	g->pre = idle_end;
+	g->ch = sel;
+	g->part = mounted;
+	ch_gates[sel]++;
+	gate_live = 1;
+	if (mounted && !row1_steady && last_closed >= 0 && now - gates[last_closed].close < CPU_HZ/10000) {
+		row1_steady = 1;			// pipelined from here on, time the lcd from now
+		row1_writes = 0;
+	}//if
+	if (cal_auto) {
+		cal_on = (gate_total == 2);		// press calibrate for the 2nd gate, f2
+		l_short = (gate_total <= 2);	// L leads shorted while calibrating
+	}//if
+	else {
+		cal_on = cal_req && gate_total >= 2;	// on request, f1 has to be in first
+		if (cal_on) cal_req = 0;
+	}//else
+}
+
+static void gate_closed(void) {
+	gate_t *g = &gates[ngates-1];
+	g->close = now;
+	g->fw = capture_cnt;
+	gate_live = 0;
+	last_closed = ngates-1;
+	if (!mounted && cal_auto && gate_total == 2 + NCH) {	// calibrated and one empty pass done
+		mount();
+		mount_t = now;
+	}//if
+}
+
+//______________________________________________________________________________
+// fixture scan, per channel tallies, taken when the channel's digit goes to the lcd
+typedef struct {
+	uint32_t reads, gates, trials, probes;		// since steady
+	uint32_t g0, t0, p0;						// at last snapshot
+	int swapped;
+	char row1[17];
+} tally_t;
+
+typedef struct { int c; double at; part_t p; } swap_t;
+
+static tally_t tally[NCH];
+static swap_t swaps[8];
+static int nswaps, scan_passes;
+static uint64_t steady_t;
+
+static void scan_done(int c) {
+	tally_t *t = &tally[c];
+	if (mounted && c == NCH-1 && ++scan_passes == 2) {
+		int i;
+		steady_t = now;			// every channel seen its part twice, count from here
+		for (i=0;i<NCH;i++) tally[i].reads = tally[i].gates = tally[i].trials = tally[i].probes = 0;
+	}//if
+	if (steady_t) {
+		t->reads++;
+		t->gates += ch_gates[c] - t->g0;
+		t->trials += ch_trials[c] - t->t0;
+		t->probes += adc_probes[c] - t->p0;
+	}//if
+	t->g0 = ch_gates[c];
+	t->t0 = ch_trials[c];
+	t->p0 = adc_probes[c];
+	memcpy(t->row1, lcd[1], sizeof(t->row1));
+	if (verbose) printf("%10.3fms ch%d |%s|\n", MS(now), c+1, lcd[1]);
+}
+
+static void scan_swaps(void) {
+	int i;
+	for (i=0;i<nswaps;i++) {
+		swap_t *w = &swaps[i];
+		if (w->c < 0 || !mounted || now < mount_t + (uint64_t) (w->at * CPU_HZ)) continue;
+		dut[w->c] = spec[w->c] = w->p;
+		tally[w->c].swapped = 1;
+		if (verbose) printf("%10.3fms ch%d part swapped\n", MS(now), w->c+1);
+		w->c = -1;
+	}//for
+}
+
+// value off lcd row 1, ie. "220.0pF", "10.00uH"
+static double lcd_value(const char *row) {
+	double v;
+	char sc, unit;
+	if (sscanf(row, "%lf%c%c", &v, &sc, &unit) != 3) return 0.0;
+	switch (sc) {
+		case 'p': return v * 1e-12;
+		case 'n': return v * 1e-9;
+		case 'u': return v * 1e-6;
+		case 'm': return v * 1e-3;
+	}//switch
+	return 0.0;
+}
+
+//______________________________________________________________________________
+static void hw_sync(void) {
+	int i;
+	for (i=0;i<SIM_R8_N;i++) {
+		uint8_t o = s8[i], v = r8[i];
+		if (o == v) continue;
+		s8[i] = v;
+		switch (i) {
+			case SIM_P1OUT:
+				if ((v & ~o) & BIT5) shift_clk();
+				break;
+			case SIM_P2OUT:
+				if ((v & ~o) & BIT4) {
+					latch595 = sr595;
+					sel = (latch595 & 7) % NCH;		// 4051 select lines
+				}//if
+				break;
+			case SIM_CACTL1:
+				if ((v & ~o) & CAIE) {
+					if (gate_live) gates[ngates-1].edges = (v & CAIFG) ? 1 : 0;
+				}//if
+				if ((o & ~v) & CAIE) {
+					if (gate_live) gate_closed();
+				}//if
+				break;
+		}//switch
+	}//for
+	for (i=0;i<SIM_R16_N;i++) {
+		uint16_t o = s16[i], v = r16[i];
+		if (o == v) continue;
+		switch (i) {
+			case SIM_TA0CTL: case SIM_TA1CTL:
+				if ((v & MC_3) == MC_1 || (v & MC_3) == MC_3) fatal("only continuous timer mode is modelled");
+				if (v & TACLR) {
+					v &= ~TACLR;
+					r16[i+1] = 0;
+					tfrac[i == SIM_TA1CTL] = 0;
+				}//if
+				break;
+			case SIM_TA0CCTL0:
+				if ((v & ~o) & CCIE) gate_started();
+				break;
+			case SIM_TA0CCTL1:
+				if ((v & ~o) & CAP) ch_trials[sel]++;		// high cap charge trial
+				break;
+			case SIM_TA1CCTL0:
+				if (!(v & 0x00E0)) txd_set(v & OUT ? 1 : 0);
+				break;
+			case SIM_TA1CCTL1:
+				if ((v & ~o) & CCIE) gie_off_t = now;		// uart up, boot doesn't count
+				break;
+			case SIM_ADC10CTL0:
+				if (v & ADC10SC) {
+					r16[i] = v & ~ADC10SC;
+					s16[i] = o;
+					adc_start();
+					v = r16[i];
+				}//if
+				break;
+		}//switch
+		r16[i] = s16[i] = v;
+	}//for
+}
+
+static void finish(void);
+
+//______________________________________________________________________________
+// pty bridge, the host talks to the firmware uart thru a pseudo terminal. sim time
+// is paced to wall time here, stdin takes control lines (cal, mount, quit)
+static uint64_t poll_t=NEVER;
+static struct timespec t_wall;
+static char ctl_buf[128];
+static int ctl_len;
+
+static void pty_open(void) {
+	struct termios tio;
+	if ((pty_fd = posix_openpt(O_RDWR|O_NOCTTY)) < 0 || grantpt(pty_fd) || unlockpt(pty_fd)) fatal("no pty");
+	const char *name = ptsname(pty_fd);
+	int slave = open(name, O_RDWR|O_NOCTTY);		// stays open, host may come and go
+	if (slave < 0 || tcgetattr(slave, &tio)) fatal("pty slave");
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+	printf("pty: %s\n", name);
+	fflush(stdout);
+	ctl_fd = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t_wall);
+	poll_t = now + 16000;
+}
+
+static void ctl_line(char *l) {
+	char sock[4], val[16], esr[16], spec_s[40];
+	int n;
+	if (!strcmp(l, "quit")) finish();
+	else if (!strcmp(l, "cal")) cal_req = 1;
+	else if ((n = sscanf(l, "mount %3s %15s %15s", sock, val, esr)) >= 1) {
+		snprintf(spec_s, sizeof(spec_s), "%s%s%s%s%s", sock, n > 1 ? ":" : "", n > 1 ? val : "", n > 2 ? ":" : "", n > 2 ? esr : "");
+		parse_part(&spec[sel], spec_s);
+		dut[sel] = spec[sel];
+		mounted = 1;
+	}//if
+	else {
+		printf("? %s\n", l);
+		fflush(stdout);
+		return;
+	}//else
+	if (log_fp) fprintf(log_fp, "ctl %.1f %s\n", US(now), l);
+	printf("ok %s\n", l);
+	fflush(stdout);
+}
+
+static void pty_poll(void) {
+	struct timespec ts;
+	struct timeval tv = { 0, 0 };
+	fd_set rd;
+	uint8_t buf[64];
+	int i, n;
+
+	poll_t = now + 16000;				// every 1ms sim time
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	double ahead = now / CPU_HZ - ((ts.tv_sec - t_wall.tv_sec) + (ts.tv_nsec - t_wall.tv_nsec) * 1e-9);
+	if (ahead > 0.0) {
+		tv.tv_sec = (long) ahead;
+		tv.tv_usec = (long) ((ahead - tv.tv_sec) * 1e6);
+	}//if
+	FD_ZERO(&rd);
+	FD_SET(pty_fd, &rd);
+	if (ctl_fd >= 0) FD_SET(ctl_fd, &rd);
+	if (select(pty_fd + 1, &rd, NULL, NULL, &tv) <= 0) return;
+
+	if (FD_ISSET(pty_fd, &rd) && (n = read(pty_fd, buf, sizeof(buf))) > 0) {
+		for (i=0;i<n;i++) {
+			uint64_t t = rx_send(buf[i]);
+			rx_total++;
+			if (log_fp) fprintf(log_fp, "rx %c %.1f %.1f\n", buf[i] > ' ' ? buf[i] : '.', US(t), US(t + 10*HOST_TBIT));
+		}//for
+	}//if
+	if (ctl_fd >= 0 && FD_ISSET(ctl_fd, &rd)) {
+		if ((n = read(ctl_fd, ctl_buf + ctl_len, sizeof(ctl_buf) - 1 - ctl_len)) <= 0) finish();	// host's gone
+		ctl_len += n;
+		ctl_buf[ctl_len] = 0;
+		char *nl;
+		while ((nl = strchr(ctl_buf, '\n'))) {
+			*nl = 0;
+			ctl_line(ctl_buf);
+			ctl_len -= nl + 1 - ctl_buf;
+			memmove(ctl_buf, nl + 1, ctl_len + 1);
+		}//while
+		if (ctl_len == sizeof(ctl_buf) - 1) ctl_len = 0;
+	}//if
+	if (log_fp) fflush(log_fp);
+}
+
+//______________________________________________________________________________
+static void sim_irq(void);
+
+static uint64_t next_event(void) {
+	uint64_t t = end_time, e;
+	int i;
+	for (i=0;i<2;i++) if (trun(i) && (e = now + timer_next(i)) < t) t = e;
+	if (osc_on && (e = (uint64_t) ceil(osc_next)) < t) t = e;
+	if (adc_done < t) t = adc_done;
+	if ((e = hc_cross()) < t) t = e;
+	if ((e = rx_next_edge()) < t) t = e;
+	if (poll_t < t) t = poll_t;
+	return t;
+}
+
+static void step(uint64_t t) {
+	if (t <= now) t = now + 1;
+	uint64_t dt = t - now;
+	int i;
+	node_step(dt);
+	now = t;								// compare / capture events land at t
+	for (i=0;i<2;i++) if (trun(i)) timer_step(i, dt);
+
+	//______________ tank oscillator, one comparator edge per period
+	double f = lc_active() ? f_tank() : 0.0;
+	if (f > 0.0) {
+		double per = CPU_HZ / f;
+		if (!osc_on) osc_next = now + per * 0.5;
+		while (osc_next <= now) {
+			hw8(SIM_CACTL1, r8[SIM_CACTL1] | CAIFG);
+			if (gate_live && (r8[SIM_CACTL1] & CAIE) && !gates[ngates-1].ovf) gates[ngates-1].edges++;
+			osc_next += per;
+		}//while
+		osc_on = 1;
+	}//if
+	else osc_on = 0;
+
+	//______________ high cap trip point
+	int out = hc_active() ? dut[sel].vc < V_CAREF : 1;
+	if (out != cmp_out) {
+		cmp_out = out;
+		timer_capture(0, 1, out);
+	}//if
+
+	if (now >= adc_done) {
+		adc_done = NEVER;
+		hw16(SIM_ADC10MEM, adc_val);
+		hw16(SIM_ADC10CTL1, r16[SIM_ADC10CTL1] & ~ADC10BUSY);
+		hw16(SIM_ADC10CTL0, r16[SIM_ADC10CTL0] | ADC10IFG);
+	}//if
+
+	int lvl = rxd_level();
+	static int last_rxd = 1;
+	if (lvl != last_rxd) {
+		last_rxd = lvl;
+		if ((r8[SIM_P2SEL] & BIT1) && !(r8[SIM_P2DIR] & BIT1)) timer_capture(1, 1, lvl);
+	}//if
+
+	tx_flush();
+	if (nswaps) scan_swaps();
+	if (now >= poll_t) pty_poll();
+	if (now >= end_time) finish();
+	sim_irq();
+}
+
+static void advance(uint64_t n) {
+	uint64_t target = now + n;
+	while (now < target) {
+		uint64_t t = next_event();
+		step(t < target ? t : target);
+	}//while
+}
+
+// longest stretch the firmware keeps interrupts off once the uart is up, a rx
+// bit isn't sampled till timer1 gets its turn
+static void gie_set(int on) {
+	if (!on && gie) gie_off_t = now;
+	if (on && !gie && (r16[SIM_TA1CCTL1] & CCIE) && now - gie_off_t > gie_off_max) gie_off_max = now - gie_off_t;
+	gie = on;
+}
+
+static void sim_irq(void) {
+	if (!gie || in_isr) return;
+	for (;;) {
+		void (*v)(void) = NULL;
+		int body = 0;
+		if ((r16[SIM_TA1CCTL0] & (CCIE|CCIFG)) == (CCIE|CCIFG)) fatal("TIMER1_A0 interrupt w/o vector");
+		if (timer_a1_pending(1)) v = TIMER1_A1_ISR;
+		else if ((r8[SIM_CACTL1] & (CAIE|CAIFG)) == (CAIE|CAIFG)) {
+			hw8(SIM_CACTL1, r8[SIM_CACTL1] & ~CAIFG);
+			v = COMPARATORA_ISR;
+			body = 8;				// capture_cnt++ and compare, no register access
+		}//if
+		else if ((r16[SIM_TA0CCTL0] & (CCIE|CCIFG)) == (CCIE|CCIFG)) {
+			hw16(SIM_TA0CCTL0, r16[SIM_TA0CCTL0] & ~CCIFG);
+			v = TIMER0_A0_ISR;
+			if (gate_live) {
+				gate_t *g = &gates[ngates-1];
+				g->open = now;
+				if ((g->held = r8[SIM_P1DIR] & ~r8[SIM_P1SEL] & (BIT2|BIT4))) gates_held++;
+			}//if
+		}//if
+		else if (timer_a1_pending(0)) v = TIMER0_A1_ISR;
+		else if ((r16[SIM_ADC10CTL0] & (ADC10IE|ADC10IFG)) == (ADC10IE|ADC10IFG)) fatal("ADC10 interrupt w/o vector");
+		if (!v) break;
+		in_isr = 1;
+		isr_gie_off = 0;
+		advance(6);
+		v();
+		hw_sync();
+		advance(5 + body);
+		in_isr = 0;
+		if (isr_gie_off) {
+			gie_set(0);
+			break;
+		}//if
+	}//for
+}
+
+//______________________________________________________________________________
+// firmware side hooks
+static void sync_fcost(void) {
+	hw_sync();
+	if (fcost_due && !in_isr) {
+		uint64_t n = fcost_due;
+		fcost_due = 0;
+		advance(n);
+	}//if
+}
+
+volatile uint8_t *sim_r8(int r) {
+	sync_fcost();
+	advance(ACCESS_CYCLES);
+	return &r8[r];
+}
+
+volatile uint16_t *sim_r16(int r) {
+	sync_fcost();
+	advance(ACCESS_CYCLES);
+	if (r == SIM_TA0IV) hw16(r, timer_iv(0));
+	if (r == SIM_TA1IV) hw16(r, timer_iv(1));
+	return &r16[r];
+}
+
+void sim_delay(uint32_t n) {
+	hw_sync();
+	if (n == 50000 && !in_isr && last_closed >= 0 && !gates[last_closed].post)
+		gates[last_closed].post = now;	// main loop delay after a latched gate
+	advance(n);
+	if (n == 50000 && !in_isr) idle_end = now;
+}
+
+void sim_bis_sr(uint16_t x) {
+	hw_sync();
+	if (x & GIE) gie_set(1);
+	if (!(x & CPUOFF)) {
+		sim_irq();
+		return;
+	}//if
+	if (gate_live && !gates[ngates-1].sleep) gates[ngates-1].sleep = now;
+	woke = 0;
+	sim_irq();
+	while (!woke) {
+		uint64_t t = next_event();
+		if (t == end_time && !trun(0) && adc_done == NEVER && rx_head == rx_tail) fatal("asleep w/ nothing to wake up");
+		step(t);
+	}//while
+}
+
+void sim_bic_sr(uint16_t x) {
+	hw_sync();
+	if (x & GIE) gie_set(0);
+}
+
+void sim_bic_sr_on_exit(uint16_t x) {
+	if (x & CPUOFF) woke = 1;
+	if (x & GIE) isr_gie_off = 1;
+}
+
+//______________________________________________________________________________
+// trace report, one line per gate then the timing model numbers
+static void report_trace(void) {
+	int i, n_pipe=0, n_ser=0, n_fit=0, lost=0;
+	double period=0, busy=0, busy_max=0, charge=0, gate=0, pre=0, post=0;
+	uint16_t ser_cnt=0, pmin=0xffff, pmax=0;
+
+	printf("gate  start_ms  charge_ms  gate_ms   count   edges  busy_ms  kind\n");
+	for (i=0;i<ngates;i++) {
+		gate_t *g = &gates[i];
+		if (!g->close) continue;
+		int piped = i && gates[i-1].close && g->start - gates[i-1].close < CPU_HZ/10000;
+		double b = MS((g->sleep ? g->sleep : g->close) - g->start);
+		if (g->fw + 1 < g->edges || g->fw > g->edges + 1) lost++;	// +-1 is where the gate edges fall
+		if (verbose || i < 8 || i >= ngates-3)
+			printf("%4d %9.3f %10.3f %8.3f %7u %7u %8.3f  %s%s\n", i+1, MS(g->start), MS(g->open - g->start),
+				MS(g->ovf - g->open), g->fw, g->edges, b,
+				i < 2 ? "calibrate" : !g->part ? "empty" : piped ? "pipelined" : "serial",
+				piped && g->sleep && g->sleep < g->open ? ", fits charge" : "");
+		else if (i == 8) printf(" ...\n");
+		if (!g->part) continue;
+		charge += MS(g->open - g->start);
+		gate += MS(g->ovf - g->open);
+		if (piped) {
+			n_pipe++;
+			period += MS(g->start - gates[i-1].start);
+			busy += b;
+			if (b > busy_max) busy_max = b;
+			if (g->sleep && g->sleep < g->open) n_fit++;
+			if (g->fw < pmin) pmin = g->fw;
+			if (g->fw > pmax) pmax = g->fw;
+		}//if
+		else {
+			n_ser++;
+			ser_cnt = g->fw;
+			pre = MS(g->start - g->pre);
+			post = MS(g->post - g->close);
+		}//else
+	}//for
+	if (!n_pipe || !n_ser) {
+		printf("not enough gates w/ a part mounted\n");
+		fails++;
+		return;
+	}//if
+	charge /= n_pipe + n_ser;
+	gate /= n_pipe + n_ser;
+	period /= n_pipe;
+	busy /= n_pipe;
+	double serial = pre + charge + gate + post + MS(50000);
+
+	printf("\ncharge phase T_c %.3fms, gate T_g %.3fms\n", charge, gate);
+	printf("serial reading, probe T_p %.3fms, convert+display T_w %.3fms\n", pre, post);
+	printf("serial back-to-back (T_p+T_c+T_g+T_w+loop delay) %8.3fms\n", serial);
+	printf("pipelined, measured period                       %8.3fms  (%.1f%% faster)\n", period, (serial/period - 1.0) * 100.0);
+	printf("pipelined main work before gate_wait             %8.3fms avg, %.3fms max, %d of %d inside charge phase\n",
+		busy, busy_max, n_fit, n_pipe);
+	printf("counts, serial %u, pipelined %u..%u, %d gate(s) off by more than one edge\n", ser_cnt, pmin, pmax, lost);
+	printf("lcd row 1 rewritten every %.3fms while pipelined\n", row1_writes > 1 ? MS(row1_last - row1_first) / (row1_writes-1) : 0.0);
+	printf("%u gate(s) counted w/ P1.2 / P1.4 driven\n", gates_held);
+
+	if (lost) fails++;
+	if (gates_held) fails++;
+	if (n_fit != n_pipe) fails++;
+	if (pmin + 1 < ser_cnt || pmax > ser_cnt + 1) fails++;
+}
+
+//______________________________________________________________________________
+// scan report, per channel readings and what each one cost, then parts per minute
+static void report_scan(void) {
+	int i, parts=0;
+	double mins = MS(now - steady_t) / 60000.0;
+	uint32_t reads=0;
+
+	if (!steady_t) {
+		printf("never got two passes w/ parts in\n");
+		fails++;
+		return;
+	}//if
+	printf("ch  part          lcd                reads  gates/rd  trials/rd  adc/rd\n");
+	for (i=0;i<NCH;i++) {
+		tally_t *t = &tally[i];
+		part_t *p = &spec[i];
+		double n = t->reads ? t->reads : 1;
+		char name[32], *err = "", *note = "";
+		snprintf(name, sizeof(name), p->val > 0.0 ? "%s" : "%s empty", p->name);
+		if (p->val > 0.0) {
+			double v = lcd_value(t->row1);
+			parts++;
+			reads += t->reads;
+			if (p->sock == 'H' && p->val > 90e-6) note = "  (100ohm range, uncalibrated)";
+			else if (fabs(v - p->val) > p->val * 0.05) err = "  <- value";
+			else if (!t->swapped && p->sock != 'H' && t->probes) err = "  <- probed a known LC part";
+			else if (!t->swapped && p->sock == 'H' && t->trials != t->reads) err = "  <- range trials on a known part";
+		}//if
+		else if (strspn(t->row1, " ") != 16) err = "  <- not empty";
+		if (*err) fails++;
+		printf("%2d  %-12s |%s| %5u  %8.2f  %9.2f  %6.2f%s%s%s\n", i+1, name, t->row1, t->reads,
+			t->gates/n, t->trials/n, t->probes/n, t->swapped ? "  (swapped)" : "", note, err);
+	}//for
+	printf("\n%d parts on %d channels, %u readings in %.2fs steady, %.0f parts/min\n",
+		parts, NCH, reads, mins * 60.0, reads / mins);
+	printf("%u gate(s) counted w/ P1.2 / P1.4 driven\n", gates_held);
+	if (gates_held) fails++;
+}
+
+//______________________________________________________________________________
+static void report_pty(void) {
+	printf("%.3fs, %u bytes in, %u lines out, lcd |%s|%s|\n", MS(now) / 1000.0, rx_total, tx_total, lcd[0], lcd[1]);
+	printf("longest w/ interrupts off %.1fus, a rx bit is %.1fus\n", US(gie_off_max), US(HOST_TBIT));
+	if (gie_off_max >= HOST_TBIT) fails++;
+	if (log_fp) fclose(log_fp);
+}
+
+static void (*report)(void) = report_trace;
+
+static void finish(void) {
+	report();
+	if (fails) printf("FAIL (%d)\n", fails);
+	exit(fails ? 1 : 0);
+}
+
+//______________________________________________________________________________
+int main(int argc, char *argv[]) {
+	double secs = 3.0;
+	int i, a = 1;
+	const char *mode = "trace";
+
+	while (a < argc && argv[a][0] == '-') {
+		if (!strcmp(argv[a], "-t") && a+1 < argc) secs = atof(argv[++a]);
+		else if (!strcmp(argv[a], "-v")) verbose = 1;
+		else if (!strcmp(argv[a], "-s") && a+1 < argc && nswaps < 8) {
+			swap_t *w = &swaps[nswaps++];
+			char *at = strchr(argv[++a], '@');
+			w->c = atoi(argv[a]) - 1;
+			if (w->c < 0 || w->c >= NCH || !at || !strchr(argv[a], ':')) fatal("swap is -s <ch>:<part>@<secs>");
+			*at = 0;
+			parse_part(&w->p, strchr(argv[a], ':') + 1);
+			w->at = atof(at+1);
+		}//if
+		else if (!strcmp(argv[a], "-f") && a+1 < argc) fcost = (uint64_t) (atof(argv[++a]) * CPU_HZ / 1000.0);
+		else if (!strcmp(argv[a], "-w") && a+1 < argc) ticks = -(int) (atof(argv[++a]) * CPU_HZ / 8 / 0x10000);
+		else if (!strcmp(argv[a], "-l") && a+1 < argc) {
+			if (!(log_fp = fopen(argv[++a], "w"))) fatal("can't open log");
+		}//if
+		else {
+			fprintf(stderr, "usage: lcsim [-t secs] [-f ms] [-v] trace [part]\n       lcsim_scan [-t secs] [-v] [-s ch:part@secs] scan [parts]\n       lcsim [-l log] [-w secs] [-v] pty\n");
+			return 2;
+		}//else
+		a++;
+	}//while
+	if (a < argc) mode = argv[a++];
+
+	for (i=0;i<NCH;i++) parse_part(&spec[i], strcmp(mode, "trace") ? "C" : "C:220p");
+	for (i=0;i<NCH && a<argc;i++,a++) parse_part(&spec[i], argv[a]);
+	for (i=0;i<NCH;i++) {
+		dut[i].sock = spec[i].sock;			// empty sockets until calibrated
+		dut[i].vc = 0.0;
+	}//for
+
+	if (!strcmp(mode, "trace")) {
+		report = report_trace;
+	}//if
+	else if (!strcmp(mode, "scan") && NCH > 1) {
+		report = report_scan;
+		gate_wrap = 1;
+	}//if
+	else if (!strcmp(mode, "pty")) {
+		report = report_pty;
+		gate_wrap = 1;
+		cal_auto = 0;
+	}//if
+	else fatal("unknown mode");
+
+	end_time = (uint64_t) ((secs + 6.0) * CPU_HZ);	// ~6s to calibrate and see the sockets empty
+	if (report == report_pty) {
+		end_time = NEVER;
+		pty_open();
+	}//if
+	hw8(SIM_CALBC1_16MHZ, 0x8f);
+	hw8(SIM_CALDCO_16MHZ, 0x9a);
+	memset(lcd, ' ', sizeof(lcd));
+	lcd[0][16] = lcd[1][16] = 0;
+
+	fw_main();
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+
+msp430.h stand-in for building lc_meter.c on the host against lcsim
+
+every register access goes thru sim_r8() / sim_r16(), that's where the
+simulator syncs firmware writes, advances its clock and runs pending ISRs
+only what lc_meter.c touches is here, bit values are the msp430g2553 ones
+
+*/
+#ifndef SIM_MSP430_H
+#define SIM_MSP430_H
+
+#include <stdint.h>
+
+enum {
+	SIM_P1OUT, SIM_P1DIR, SIM_P1SEL, SIM_P1SEL2, SIM_P1REN,
+	SIM_P2OUT, SIM_P2DIR, SIM_P2SEL, SIM_P2SEL2,
+	SIM_CACTL1, SIM_CACTL2, SIM_CAPD, SIM_ADC10AE0,
+	SIM_BCSCTL1, SIM_DCOCTL, SIM_CALBC1_16MHZ, SIM_CALDCO_16MHZ,
+	SIM_R8_N,
+};
+
+enum {	// timer blocks keep this order, lcsim indexes them by offset
+	SIM_TA0CTL, SIM_TA0R, SIM_TA0CCTL0, SIM_TA0CCTL1, SIM_TA0CCTL2, SIM_TA0CCR0, SIM_TA0CCR1, SIM_TA0CCR2,
+	SIM_TA1CTL, SIM_TA1R, SIM_TA1CCTL0, SIM_TA1CCTL1, SIM_TA1CCTL2, SIM_TA1CCR0, SIM_TA1CCR1, SIM_TA1CCR2,
+	SIM_ADC10CTL0, SIM_ADC10CTL1, SIM_ADC10MEM, SIM_WDTCTL,
+	SIM_TA0IV, SIM_TA1IV,
+	SIM_R16_N,
+};
+
+volatile uint8_t *sim_r8(int r);
+volatile uint16_t *sim_r16(int r);
+void sim_delay(uint32_t n);
+void sim_bis_sr(uint16_t x);
+void sim_bic_sr(uint16_t x);
+void sim_bic_sr_on_exit(uint16_t x);
+
+#define P1OUT			(*sim_r8(SIM_P1OUT))
+#define P1DIR			(*sim_r8(SIM_P1DIR))
+#define P1SEL			(*sim_r8(SIM_P1SEL))
+#define P1SEL2			(*sim_r8(SIM_P1SEL2))
+#define P1REN			(*sim_r8(SIM_P1REN))
+#define P2OUT			(*sim_r8(SIM_P2OUT))
+#define P2DIR			(*sim_r8(SIM_P2DIR))
+#define P2SEL			(*sim_r8(SIM_P2SEL))
+#define P2SEL2			(*sim_r8(SIM_P2SEL2))
+#define CACTL1			(*sim_r8(SIM_CACTL1))
+#define CACTL2			(*sim_r8(SIM_CACTL2))
+#define CAPD			(*sim_r8(SIM_CAPD))
+#define ADC10AE0		(*sim_r8(SIM_ADC10AE0))
+#define BCSCTL1			(*sim_r8(SIM_BCSCTL1))
+#define DCOCTL			(*sim_r8(SIM_DCOCTL))
+#define CALBC1_16MHZ	(*sim_r8(SIM_CALBC1_16MHZ))
+#define CALDCO_16MHZ	(*sim_r8(SIM_CALDCO_16MHZ))
+
+#define TA0CTL			(*sim_r16(SIM_TA0CTL))
+#define TA0R			(*sim_r16(SIM_TA0R))
+#define TA0CCTL0		(*sim_r16(SIM_TA0CCTL0))
+#define TA0CCTL1		(*sim_r16(SIM_TA0CCTL1))
+#define TA0CCTL2		(*sim_r16(SIM_TA0CCTL2))
+#define TA0CCR0			(*sim_r16(SIM_TA0CCR0))
+#define TA0CCR1			(*sim_r16(SIM_TA0CCR1))
+#define TA0CCR2			(*sim_r16(SIM_TA0CCR2))
+#define TA0IV			(*sim_r16(SIM_TA0IV))
+#define TA1CTL			(*sim_r16(SIM_TA1CTL))
+#define TA1R			(*sim_r16(SIM_TA1R))
+#define TA1CCTL0		(*sim_r16(SIM_TA1CCTL0))
+#define TA1CCTL1		(*sim_r16(SIM_TA1CCTL1))
+#define TA1CCTL2		(*sim_r16(SIM_TA1CCTL2))
+#define TA1CCR0			(*sim_r16(SIM_TA1CCR0))
+#define TA1CCR1			(*sim_r16(SIM_TA1CCR1))
+#define TA1CCR2			(*sim_r16(SIM_TA1CCR2))
+#define TA1IV			(*sim_r16(SIM_TA1IV))
+#define ADC10CTL0		(*sim_r16(SIM_ADC10CTL0))
+#define ADC10CTL1		(*sim_r16(SIM_ADC10CTL1))
+#define ADC10MEM		(*sim_r16(SIM_ADC10MEM))
+#define WDTCTL			(*sim_r16(SIM_WDTCTL))
+
+#define BIT0	0x01
+#define BIT1	0x02
+#define BIT2	0x04
+#define BIT3	0x08
+#define BIT4	0x10
+#define BIT5	0x20
+#define BIT6	0x40
+#define BIT7	0x80
+
+#define GIE			0x0008
+#define CPUOFF		0x0010
+#define LPM0_bits	(CPUOFF)
+
+#define WDTPW		0x5A00
+#define WDTHOLD		0x0080
+
+//______________ timer_a
+#define TASSEL_2	0x0200
+#define ID_2		0x0080
+#define ID_3		0x00C0
+#define MC_1		0x0010
+#define MC_2		0x0020
+#define MC_3		0x0030
+#define TACLR		0x0004
+#define TAIE		0x0002
+#define TAIFG		0x0001
+#define CM_1		0x4000
+#define CM_2		0x8000
+#define CCIS_0		0x0000
+#define CCIS_1		0x1000
+#define SCS			0x0800
+#define SCCI		0x0400
+#define CAP			0x0100
+#define OUTMOD_0	0x0000
+#define OUTMOD_1	0x0020
+#define OUTMOD_5	0x00A0
+#define CCIE		0x0010
+#define CCI			0x0008
+#define OUT			0x0004
+#define COV			0x0002
+#define CCIFG		0x0001
+
+//______________ comparator_a+
+#define CAREF_1		0x10
+#define CAREF_2		0x20
+#define CAON		0x08
+#define CAIES		0x04
+#define CAIE		0x02
+#define CAIFG		0x01
+#define P2CA4		0x40
+#define P2CA3		0x20
+#define P2CA2		0x10
+#define CAF			0x02
+
+//______________ adc10
+#define ADC10SHT_1	0x0800
+#define ADC10SHT_2	0x1000
+#define REFON		0x0020
+#define ADC10ON		0x0010
+#define ADC10IE		0x0008
+#define ADC10IFG	0x0004
+#define ENC			0x0002
+#define ADC10SC		0x0001
+#define INCH_4		0x4000
+#define ADC10BUSY	0x0001
+
+//______________ intrinsics
+#define __interrupt
+#define __delay_cycles(n)				sim_delay(n)
+#define _BIS_SR(x)						sim_bis_sr(x)
+#define _BIC_SR(x)						sim_bic_sr(x)
+#define __bic_SR_register_on_exit(x)	sim_bic_sr_on_exit(x)
+
+#endif